@@ -6,6 +6,25 @@
 #include <iterator>
 #include <sstream>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <charconv>
+#include <filesystem>
+#include <unordered_map>
+#include <deque>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define CSVLIB_HAS_MMAP
+#endif
 
 namespace csvlib {
 
@@ -14,7 +33,7 @@ void split(std::string str, const std::string& delimiter, std::vector<std::strin
 
     while (pos != std::string::npos) {
         result.push_back(str.substr(0, pos));
-        str.erase(0, pos + 1);
+        str.erase(0, pos + delimiter.size());
         pos = str.find(delimiter);
     }
 
@@ -42,18 +61,20 @@ public:
     }
 
     CSV(const char* filename, const std::vector<std::string>& fieldnames = {}, const std::string& delimiter = ",") {
+        this->filename = filename;
         this->delimiter = delimiter;
         this->fieldnames = fieldnames;
     }
 
     CSV(const char* filename, std::string fielnames, const std::string& delimiter = ",") {
+        this->filename = filename;
         this->delimiter = delimiter;
         
         auto pos = fielnames.find(delimiter);
 
         while (pos != std::string::npos) {
             this->fieldnames.push_back(fielnames.substr(0, pos));
-            fielnames.erase(0, pos + 1);
+            fielnames.erase(0, pos + delimiter.size());
             pos = fielnames.find(delimiter);
         }
     }
@@ -66,6 +87,7 @@ protected:
     virtual void open_file(const char* filename) {}
 
     std::fstream file;
+    std::string filename;
     std::string delimiter;
     std::vector<std::string> fieldnames;
 };
@@ -97,6 +119,8 @@ public:
 
         if (std::getline(file, line))
             return this->parse(line);
+
+        return std::nullopt;
     }
 
     std::vector<std::vector<std::string>> read_all_lines() {
@@ -175,6 +199,692 @@ protected:
     }
 };
 
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'C', 'S', 'V', 'S', 'N', 'A', 'P', '1'};
+const uint32_t SNAPSHOT_VERSION = 3;
+const size_t SNAPSHOT_MTIME_OFFSET = 32; // magic, version, column count, rows, source size come before source mtime
+
+enum ColumnType : uint32_t {
+    COLUMN_INTEGER = 0,
+    COLUMN_DICTIONARY = 1,
+    COLUMN_TEXT = 2
+};
+
+// hash the whole file a word at a time
+bool hash_file(const std::filesystem::path& path, uint64_t& hash) {
+    std::ifstream source(path, std::ios_base::in | std::ios_base::binary);
+    if (!source)
+        return false;
+
+    hash = 14695981039346656037ull;
+    std::vector<char> chunk(1 << 20); // multiple of 8, so only the last chunk has a tail
+    while (source) {
+        source.read(chunk.data(), chunk.size());
+        size_t count = source.gcount();
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, chunk.data() + i, sizeof(word));
+            hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+            hash ^= hash >> 29;
+        }
+        for (; i < count; i++)
+            hash = (hash ^ static_cast<unsigned char>(chunk[i])) * 1099511628211ull;
+    }
+
+    return !source.bad();
+}
+
+// parse canonical decimal int64 (the one that prints back unchanged)
+bool parse_integer(std::string_view str, int64_t& value) {
+    if (str.empty())
+        return false;
+
+    auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (error != std::errc() || end != str.data() + str.size())
+        return false;
+
+    char printed[24];
+    auto [printed_end, printed_error] = std::to_chars(printed, printed + sizeof(printed), value);
+    return str == std::string_view(printed, printed_end - printed);
+}
+
+// create unique temporary file next to filename, so concurrent writers never share it
+bool make_temp_file(const std::string& filename, std::string& temp_filename) {
+#ifdef CSVLIB_HAS_MMAP
+    std::vector<char> name(filename.begin(), filename.end());
+    const char suffix[] = ".tmp.XXXXXX";
+    name.insert(name.end(), suffix, suffix + sizeof(suffix));
+
+    int fd = mkstemp(name.data());
+    if (fd < 0)
+        return false;
+    fchmod(fd, 0644); // mkstemp creates 0600 file, snapshot should be readable like a normal file
+    ::close(fd);
+
+    temp_filename = name.data();
+    return true;
+#else
+    std::random_device random;
+    for (int attempt = 0; attempt < 16; attempt++) {
+        std::ostringstream name;
+        name << filename << ".tmp." << std::hex << random() << random();
+        if (!std::filesystem::exists(name.str())) {
+            temp_filename = name.str();
+            return true;
+        }
+    }
+
+    return false;
+#endif
+}
+
+// sequential writer that keeps every section 8-byte aligned
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::ostream& stream) : stream(stream) {}
+
+    template <typename T>
+    void put(const T& value) {
+        put_raw(&value, sizeof(T));
+    }
+
+    void put_raw(const void* data, size_t size) {
+        stream.write(static_cast<const char*>(data), size);
+        offset += size;
+    }
+
+    void put_string(std::string_view str) {
+        put<uint64_t>(str.size());
+        put_raw(str.data(), str.size());
+        align();
+    }
+
+    void align() {
+        static const char zeros[8] = {};
+        put_raw(zeros, (8 - offset % 8) % 8);
+    }
+
+private:
+    std::ostream& stream;
+    uint64_t offset = 0;
+};
+
+// bounds checked reader over mapped snapshot
+class SnapshotReader {
+public:
+    SnapshotReader(const char* data, size_t size) : data(data), size(size) {}
+
+    template <typename T>
+    bool get(T& value) {
+        if (size - offset < sizeof(T))
+            return false;
+        std::memcpy(&value, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    // returns pointer to count aligned values of T and skips them
+    template <typename T>
+    const T* take(uint64_t count) {
+        if (count > (size - offset) / sizeof(T))
+            return nullptr;
+        auto result = reinterpret_cast<const T*>(data + offset);
+        offset += count * sizeof(T);
+        return align() ? result : nullptr;
+    }
+
+    bool get_string(std::string& str) {
+        uint64_t length;
+        if (!get(length) || length > size - offset)
+            return false;
+        str.assign(data + offset, length);
+        offset += length;
+        return align();
+    }
+
+    bool align() {
+        size_t padding = (8 - offset % 8) % 8;
+        if (size - offset < padding)
+            return false;
+        offset += padding;
+        return true;
+    }
+
+private:
+    const char* data;
+    size_t size;
+    size_t offset = 0;
+};
+
+}
+
+class CSVSnapshot {
+public:
+    struct SourceStamp {
+        std::string path;
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        uint64_t hash = 0;
+    };
+
+    CSVSnapshot() : data(nullptr), size(0), mapped(false), row_count(0) {}
+
+    CSVSnapshot(const CSVSnapshot&) = delete;
+    CSVSnapshot& operator=(const CSVSnapshot&) = delete;
+
+    CSVSnapshot(CSVSnapshot&& other) noexcept : data(nullptr), size(0), mapped(false), row_count(0) {
+        *this = std::move(other);
+    }
+
+    CSVSnapshot& operator=(CSVSnapshot&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        close();
+        data = other.data;
+        size = other.size;
+        mapped = other.mapped;
+        buffer = std::move(other.buffer); // moving vector keeps its storage, so column pointers stay valid
+        row_count = other.row_count;
+        fieldnames = std::move(other.fieldnames);
+        columns = std::move(other.columns);
+
+        other.data = nullptr;
+        other.size = 0;
+        other.mapped = false;
+        other.row_count = 0;
+        return *this;
+    }
+
+    ~CSVSnapshot() {
+        close();
+    }
+
+    static std::optional<SourceStamp> stamp_source(const char* source_filename) {
+        SourceStamp stamp;
+        std::error_code error;
+
+        auto path = std::filesystem::absolute(source_filename, error);
+        if (error)
+            return std::nullopt;
+        stamp.path = path.lexically_normal().string();
+
+        stamp.size = std::filesystem::file_size(path, error);
+        if (error)
+            return std::nullopt;
+
+        auto mtime = std::filesystem::last_write_time(path, error);
+        if (error)
+            return std::nullopt;
+        stamp.mtime = mtime.time_since_epoch().count();
+
+        if (!hash_file(path, stamp.hash))
+            return std::nullopt;
+
+        return stamp;
+    }
+
+    static bool write(const char* cache_filename, const SourceStamp& source, uint64_t start, const std::string& delimiter, const std::vector<std::string>& fieldnames, const std::vector<std::map<std::string, std::string>>& data) {
+        // write to unique temporary file and rename it, so readers never see a half written snapshot
+        std::string temp_filename;
+        if (!make_temp_file(cache_filename, temp_filename))
+            return false;
+
+        std::ofstream file(temp_filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        serialize(file, source, start, delimiter, fieldnames, data);
+        file.close();
+
+        std::error_code error;
+        if (file)
+            std::filesystem::rename(temp_filename, cache_filename, error);
+        if (!file || error) {
+            std::filesystem::remove(temp_filename, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool open(const char* cache_filename, const char* source_filename, uint64_t start, const std::string& delimiter, const std::vector<std::string>& fieldnames) {
+        close();
+
+#ifdef CSVLIB_HAS_MMAP
+        int fd = ::open(cache_filename, O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+            return false;
+
+        data = static_cast<const char*>(mapping);
+        size = info.st_size;
+        mapped = true;
+#else
+        std::ifstream cache(cache_filename, std::ios_base::in | std::ios_base::binary);
+        if (!cache)
+            return false;
+
+        buffer.assign(std::istreambuf_iterator<char>(cache), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+#endif
+
+        if (!load(cache_filename, source_filename, start, delimiter, fieldnames)) {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void assign(const std::string& delimiter, const std::vector<std::string>& fieldnames, const std::vector<std::map<std::string, std::string>>& data) {
+        close();
+
+        std::ostringstream stream(std::ios_base::out | std::ios_base::binary);
+        serialize(stream, SourceStamp(), 0, delimiter, fieldnames, data);
+
+        auto image = stream.str();
+        buffer.assign(image.begin(), image.end());
+        this->data = buffer.data();
+        size = buffer.size();
+
+        load(nullptr, nullptr, 0, delimiter, fieldnames);
+    }
+
+    void close() {
+#ifdef CSVLIB_HAS_MMAP
+        if (mapped)
+            munmap(const_cast<char*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+        mapped = false;
+        buffer.clear();
+        buffer.shrink_to_fit();
+        row_count = 0;
+        fieldnames.clear();
+        columns.clear();
+    }
+
+    size_t rows() const {
+        return row_count;
+    }
+
+    const std::vector<std::string>& get_fieldnames() const {
+        return fieldnames;
+    }
+
+    bool is_integer(size_t column) const {
+        return columns[column].integer;
+    }
+
+    int64_t integer(size_t row, size_t column) const {
+        return columns[column].integers[row];
+    }
+
+    std::string_view text(size_t row, size_t column) const {
+        const auto& col = columns[column];
+        size_t index = col.codes ? col.codes[row] : row;
+
+        // offsets and codes are only validated here, so opening a snapshot doesn't have to read all of it
+        if (index >= col.dictionary_size || col.offsets[index] > col.offsets[index + 1] || col.offsets[index + 1] > col.bytes_size)
+            throw std::out_of_range("corrupted csv snapshot");
+
+        return std::string_view(col.bytes + col.offsets[index], col.offsets[index + 1] - col.offsets[index]);
+    }
+
+    std::string value(size_t row, size_t column) const {
+        if (columns[column].integer)
+            return std::to_string(integer(row, column));
+
+        return std::string(text(row, column));
+    }
+
+    std::map<std::string, std::string> row(size_t row) const {
+        std::map<std::string, std::string> result;
+
+        for (size_t i = 0; i < columns.size(); i++)
+            result[fieldnames[i]] = value(row, i);
+
+        return result;
+    }
+
+    std::vector<std::map<std::string, std::string>> to_dicts() const {
+        std::vector<std::map<std::string, std::string>> result;
+        result.reserve(row_count);
+
+        for (size_t i = 0; i < row_count; i++)
+            result.push_back(row(i));
+
+        return result;
+    }
+
+private:
+    struct Column {
+        bool integer;
+        const int64_t* integers;
+        const uint64_t* offsets;
+        const char* bytes;
+        uint64_t bytes_size;
+        uint64_t dictionary_size;
+        const uint32_t* codes;
+    };
+
+    static void serialize(std::ostream& stream, const SourceStamp& source, uint64_t start, const std::string& delimiter, const std::vector<std::string>& fieldnames, const std::vector<std::map<std::string, std::string>>& data) {
+        SnapshotWriter writer(stream);
+
+        writer.put_raw(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        writer.put<uint32_t>(SNAPSHOT_VERSION);
+        writer.put<uint32_t>(fieldnames.size());
+        writer.put<uint64_t>(data.size());
+        writer.put<uint64_t>(source.size);
+        writer.put<int64_t>(source.mtime);
+        writer.put<uint64_t>(source.hash);
+        writer.put<uint64_t>(start);
+        writer.put_string(source.path);
+        writer.put_string(delimiter);
+
+        static const std::string empty;
+        for (const auto& key : fieldnames) {
+            std::vector<std::string_view> values;
+            values.reserve(data.size());
+            for (const auto& line : data) {
+                auto it = line.find(key);
+                values.push_back(it != line.end() ? std::string_view(it->second) : std::string_view(empty));
+            }
+
+            writer.put_string(key);
+
+            std::vector<int64_t> integers;
+            integers.reserve(values.size());
+            for (const auto& value : values) {
+                int64_t integer;
+                if (!parse_integer(value, integer))
+                    break;
+                integers.push_back(integer);
+            }
+
+            if (integers.size() == values.size()) {
+                writer.put<uint32_t>(COLUMN_INTEGER);
+                writer.put<uint32_t>(0);
+                writer.put_raw(integers.data(), integers.size() * sizeof(int64_t));
+                writer.align();
+                continue;
+            }
+
+            std::unordered_map<std::string_view, uint32_t> dictionary;
+            std::vector<std::string_view> strings;
+            std::vector<uint32_t> codes;
+            codes.reserve(values.size());
+            uint64_t total_bytes = 0, dictionary_bytes = 0;
+            for (const auto& value : values) {
+                auto [it, inserted] = dictionary.emplace(value, strings.size());
+                if (inserted) {
+                    strings.push_back(value);
+                    dictionary_bytes += value.size();
+                }
+                codes.push_back(it->second);
+                total_bytes += value.size();
+            }
+
+            // dictionary pays off only while distinct values are well below row count
+            uint64_t dictionary_cost = (strings.size() + 1) * sizeof(uint64_t) + dictionary_bytes + codes.size() * sizeof(uint32_t);
+            uint64_t text_cost = (values.size() + 1) * sizeof(uint64_t) + total_bytes;
+            bool encoded = dictionary_cost < text_cost;
+            const auto& stored = encoded ? strings : values;
+
+            writer.put<uint32_t>(encoded ? COLUMN_DICTIONARY : COLUMN_TEXT);
+            writer.put<uint32_t>(0);
+            if (encoded)
+                writer.put<uint64_t>(strings.size());
+
+            uint64_t offset = 0;
+            writer.put<uint64_t>(offset);
+            for (const auto& str : stored) {
+                offset += str.size();
+                writer.put<uint64_t>(offset);
+            }
+            for (const auto& str : stored)
+                writer.put_raw(str.data(), str.size());
+            writer.align();
+
+            if (encoded) {
+                writer.put_raw(codes.data(), codes.size() * sizeof(uint32_t));
+                writer.align();
+            }
+        }
+    }
+
+    bool load(const char* cache_filename, const char* source_filename, uint64_t start, const std::string& delimiter, const std::vector<std::string>& fieldnames) {
+        SnapshotReader reader(data, size);
+
+        char magic[sizeof(SNAPSHOT_MAGIC)];
+        uint32_t version, column_count;
+        uint64_t rows, stored_start;
+        SourceStamp stored;
+        std::string stored_delimiter;
+        for (auto& c : magic)
+            if (!reader.get(c))
+                return false;
+        if (std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0)
+            return false;
+        if (!reader.get(version) || version != SNAPSHOT_VERSION || !reader.get(column_count) || !reader.get(rows))
+            return false;
+        if (!reader.get(stored.size) || !reader.get(stored.mtime) || !reader.get(stored.hash) || !reader.get(stored_start) || !reader.get_string(stored.path))
+            return false;
+        if (!reader.get_string(stored_delimiter) || stored_delimiter != delimiter || column_count != fieldnames.size())
+            return false;
+
+        if (source_filename) {
+            if (stored_start != start)
+                return false; // snapshot holds rows from another position in the file
+
+            std::error_code error;
+            auto path = std::filesystem::absolute(source_filename, error);
+            if (error || path.lexically_normal().string() != stored.path)
+                return false;
+            if (std::filesystem::file_size(path, error) != stored.size || error)
+                return false;
+
+            // same path, size and mtime is trusted, content hash only confirms a file that was touched
+            auto mtime = std::filesystem::last_write_time(path, error);
+            if (error)
+                return false;
+            int64_t current_mtime = mtime.time_since_epoch().count();
+            if (current_mtime != stored.mtime) {
+                uint64_t hash;
+                if (!hash_file(path, hash) || hash != stored.hash)
+                    return false;
+
+                // content is unchanged, store new mtime so the next open doesn't hash the file again
+                std::fstream cache(cache_filename, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+                cache.seekp(SNAPSHOT_MTIME_OFFSET);
+                cache.write(reinterpret_cast<const char*>(&current_mtime), sizeof(current_mtime));
+            }
+        }
+
+        row_count = rows;
+        for (uint32_t i = 0; i < column_count; i++) {
+            std::string key;
+            uint32_t type, reserved;
+            if (!reader.get_string(key) || key != fieldnames[i] || !reader.get(type) || !reader.get(reserved))
+                return false;
+
+            Column column = {};
+            if (type == COLUMN_INTEGER) {
+                column.integer = true;
+                if (!(column.integers = reader.take<int64_t>(rows)))
+                    return false;
+            } else if (type == COLUMN_DICTIONARY || type == COLUMN_TEXT) {
+                column.integer = false;
+                if (type == COLUMN_DICTIONARY) {
+                    if (!reader.get(column.dictionary_size))
+                        return false;
+                } else {
+                    column.dictionary_size = rows;
+                }
+                if (column.dictionary_size >= size)
+                    return false;
+                if (!(column.offsets = reader.take<uint64_t>(column.dictionary_size + 1)))
+                    return false;
+                column.bytes_size = column.offsets[column.dictionary_size];
+                if (!(column.bytes = reader.take<char>(column.bytes_size)))
+                    return false;
+                if (type == COLUMN_DICTIONARY && !(column.codes = reader.take<uint32_t>(rows)))
+                    return false;
+            } else {
+                return false;
+            }
+
+            this->fieldnames.push_back(key);
+            columns.push_back(column);
+        }
+
+        return true;
+    }
+
+    const char* data;
+    size_t size;
+    bool mapped;
+    std::vector<char> buffer;
+    size_t row_count;
+    std::vector<std::string> fieldnames;
+    std::vector<Column> columns;
+};
+
+class CSVStringPool {
+public:
+    CSVStringPool() {}
+
+    CSVStringPool(const CSVStringPool&) = delete;
+    CSVStringPool& operator=(const CSVStringPool&) = delete;
+    CSVStringPool(CSVStringPool&&) = default; // moving deque keeps strings in place, so views in codes stay valid
+    CSVStringPool& operator=(CSVStringPool&&) = default;
+
+    uint32_t intern(std::string_view str) {
+        auto it = codes.find(str);
+        if (it != codes.end())
+            return it->second;
+
+        uint32_t code = strings.size();
+        strings.emplace_back(str);
+        codes.emplace(strings.back(), code);
+
+        return code;
+    }
+
+    std::optional<uint32_t> find(std::string_view str) const {
+        auto it = codes.find(str);
+        if (it == codes.end())
+            return std::nullopt;
+
+        return it->second;
+    }
+
+    std::string_view at(uint32_t code) const {
+        return strings[code];
+    }
+
+    size_t size() const {
+        return strings.size();
+    }
+
+private:
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, uint32_t> codes;
+};
+
+class CSVColumn {
+public:
+    CSVColumn() : encoded(false), max_cardinality(0) {}
+
+    CSVColumn(bool encoded, size_t max_cardinality) : encoded(encoded), max_cardinality(max_cardinality) {}
+
+    void push_back(std::string_view value) {
+        if (!encoded) {
+            values.emplace_back(value);
+            return;
+        }
+
+        auto code = pool.find(value);
+        if (code) {
+            codes.push_back(*code);
+            return;
+        }
+
+        if (pool.size() < max_cardinality) {
+            codes.push_back(pool.intern(value));
+            return;
+        }
+
+        // too many distinct values, decode what we have and store plain strings from now on
+        values.reserve(codes.size() + 1);
+        for (auto c : codes)
+            values.emplace_back(pool.at(c));
+        values.emplace_back(value);
+
+        encoded = false;
+        codes.clear();
+        codes.shrink_to_fit();
+        pool = CSVStringPool();
+    }
+
+    size_t size() const {
+        return encoded ? codes.size() : values.size();
+    }
+
+    bool is_encoded() const {
+        return encoded;
+    }
+
+    uint32_t code(size_t row) const {
+        check_encoded();
+        return codes[row];
+    }
+
+    const std::vector<uint32_t>& get_codes() const {
+        check_encoded();
+        return codes;
+    }
+
+    const CSVStringPool& dictionary() const {
+        check_encoded();
+        return pool;
+    }
+
+    std::optional<uint32_t> find(std::string_view value) const {
+        check_encoded(); // plain column has no codes, nullopt would wrongly mean the value is absent
+        return pool.find(value);
+    }
+
+    std::string_view value(size_t row) const {
+        return encoded ? pool.at(codes[row]) : std::string_view(values[row]);
+    }
+
+private:
+    void check_encoded() const {
+        if (!encoded)
+            throw std::logic_error("csv column is not dictionary-encoded");
+    }
+
+    bool encoded;
+    size_t max_cardinality;
+    CSVStringPool pool;
+    std::vector<uint32_t> codes;
+    std::vector<std::string> values;
+};
+
 class CSVDictReader : virtual CSV {
 public:
     CSVDictReader() : CSV() {}
@@ -202,6 +912,8 @@ public:
 
         if (std::getline(file, line))
             return this->parse(line);
+
+        return std::nullopt;
     }
 
     std::vector<std::map<std::string, std::string>> read_all_lines() {
@@ -214,6 +926,73 @@ public:
         return result;
     }
 
+    std::vector<std::map<std::string, std::string>> read_all_lines(const char* cache_filename) {
+        auto start = file.tellg(); // snapshot holds rows from here on, so it is only valid for the same position
+        if (start < 0)
+            return read_all_lines();
+
+        CSVSnapshot snapshot;
+        if (snapshot.open(cache_filename, filename.c_str(), start, delimiter, fieldnames)) {
+            file.seekg(0, std::ios_base::end); // leave the stream where parsing would have left it
+            return snapshot.to_dicts();
+        }
+
+        auto source = CSVSnapshot::stamp_source(filename.c_str()); // stamp before parsing, so a file rewritten meanwhile is not cached as current
+        auto result = read_all_lines();
+        if (source)
+            CSVSnapshot::write(cache_filename, *source, start, delimiter, fieldnames, result); // cache is optional, failure to write it is not an error
+
+        return result;
+    }
+
+    CSVSnapshot read_snapshot(const char* cache_filename) {
+        CSVSnapshot snapshot;
+        auto start = file.tellg();
+        if (start >= 0 && snapshot.open(cache_filename, filename.c_str(), start, delimiter, fieldnames)) {
+            file.seekg(0, std::ios_base::end);
+            return snapshot;
+        }
+
+        auto source = start >= 0 ? CSVSnapshot::stamp_source(filename.c_str()) : std::nullopt;
+        auto result = read_all_lines();
+        if (source && CSVSnapshot::write(cache_filename, *source, start, delimiter, fieldnames, result) && snapshot.open(cache_filename, filename.c_str(), start, delimiter, fieldnames))
+            return snapshot;
+
+        snapshot.assign(delimiter, fieldnames, result);
+        return snapshot;
+    }
+
+    std::map<std::string, CSVColumn> read_all_columns(const std::vector<std::string>& encoded_fieldnames = {}, size_t max_cardinality = 65536) {
+        for (const auto& key : encoded_fieldnames)
+            if (std::find(fieldnames.begin(), fieldnames.end(), key) == fieldnames.end())
+                throw std::invalid_argument("unknown csv fieldname to encode: " + key);
+
+        std::vector<CSVColumn> columns;
+        columns.reserve(fieldnames.size());
+        for (const auto& key : fieldnames) {
+            bool encoded = std::find(encoded_fieldnames.begin(), encoded_fieldnames.end(), key) != encoded_fieldnames.end();
+            columns.emplace_back(encoded, max_cardinality);
+        }
+
+        std::string line;
+        while (std::getline(file, line)) {
+            std::string_view rest(line);
+
+            // same splitting as parse(), but over views so encoded cells are never copied
+            for (auto& column : columns) {
+                auto pos = rest.find(delimiter);
+                column.push_back(rest.substr(0, pos));
+                rest = pos == std::string_view::npos ? std::string_view() : rest.substr(pos + delimiter.size());
+            }
+        }
+
+        std::map<std::string, CSVColumn> result;
+        for (size_t i = 0; i < fieldnames.size(); i++)
+            result.emplace(fieldnames[i], std::move(columns[i]));
+
+        return result;
+    }
+
 protected:
     void open_file(const char* filename) override {
         file.open(filename, std::ios_base::in);
@@ -226,7 +1005,7 @@ protected:
         for (const auto& key : this->fieldnames) {
             auto pos = line.find(delimiter);
             result[key] = line.substr(0, pos);
-            line.erase(0, pos + 1);
+            line.erase(0, pos + delimiter.size());
         }
 
         return result;
@@ -293,4 +1072,125 @@ protected:
     }
 };
 
+class CSVRecordView {
+public:
+    explicit CSVRecordView(const std::map<std::string, std::string>& record) : record(&record) {}
+
+    const std::string& at(const std::string& fieldname) const {
+        return record->at(fieldname);
+    }
+
+    const std::map<std::string, std::string>& fields() const {
+        return *record;
+    }
+
+private:
+    const std::map<std::string, std::string>* record;
+};
+
+class CSVIndex {
+public:
+    CSVIndex(const std::vector<std::map<std::string, std::string>>& data, const std::vector<std::string>& key_fieldnames) : data(&data), key_fieldnames(key_fieldnames), count(0) {
+        if (data.size() >= UINT32_MAX)
+            throw std::length_error("too many rows to index");
+
+        // keep load factor at most 1/2, capacity is a power of two so probing can use a mask
+        size_t capacity = 2;
+        while (capacity < data.size() * 2)
+            capacity *= 2;
+        slots.assign(capacity, Slot{0, 0});
+
+        std::vector<std::string_view> key(key_fieldnames.size());
+        for (size_t row = 0; row < data.size(); row++) {
+            for (size_t i = 0; i < key.size(); i++)
+                key[i] = field(row, i);
+
+            auto hash = hash_key(key);
+            auto slot = probe(key, hash);
+            if (slots[slot].row != 0)
+                continue; // duplicate key, first row wins
+
+            slots[slot] = Slot{static_cast<uint32_t>(row + 1), static_cast<uint32_t>(hash >> 32)};
+            count++;
+        }
+    }
+
+    CSVIndex(std::vector<std::map<std::string, std::string>>&& data, const std::vector<std::string>& key_fieldnames) = delete;
+
+    std::optional<CSVRecordView> find(const std::vector<std::string>& key) const {
+        if (key.size() != key_fieldnames.size())
+            throw std::invalid_argument("key has wrong number of values");
+
+        auto row = slots[probe(key, hash_key(key))].row;
+        if (row == 0)
+            return std::nullopt;
+
+        return CSVRecordView((*data)[row - 1]);
+    }
+
+    std::optional<CSVRecordView> find(std::string_view key) const {
+        if (key_fieldnames.size() != 1)
+            throw std::invalid_argument("single value key on composite index");
+
+        auto row = slots[probe(&key, hash_key(&key))].row;
+        if (row == 0)
+            return std::nullopt;
+
+        return CSVRecordView((*data)[row - 1]);
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+private:
+    struct Slot {
+        uint32_t row;
+        uint32_t tag;
+    };
+
+    std::string_view field(size_t row, size_t column) const {
+        const auto& line = (*data)[row];
+        auto it = line.find(key_fieldnames[column]);
+        return it != line.end() ? std::string_view(it->second) : std::string_view();
+    }
+
+    template <typename Key>
+    uint64_t hash_key(const Key& key) const {
+        uint64_t result = 0x9e3779b97f4a7c15ull;
+
+        for (size_t i = 0; i < key_fieldnames.size(); i++) {
+            result ^= std::hash<std::string_view>()(key[i]);
+            result *= 0xbf58476d1ce4e5b9ull;
+            result ^= result >> 31;
+        }
+
+        return result;
+    }
+
+    template <typename Key>
+    size_t probe(const Key& key, uint64_t hash) const {
+        size_t mask = slots.size() - 1;
+        size_t slot = hash & mask;
+        uint32_t tag = hash >> 32;
+
+        for (; slots[slot].row != 0; slot = (slot + 1) & mask) {
+            if (slots[slot].tag != tag)
+                continue;
+
+            size_t i = 0;
+            while (i < key_fieldnames.size() && field(slots[slot].row - 1, i) == std::string_view(key[i]))
+                i++;
+            if (i == key_fieldnames.size())
+                break;
+        }
+
+        return slot;
+    }
+
+    const std::vector<std::map<std::string, std::string>>* data;
+    std::vector<std::string> key_fieldnames;
+    std::vector<Slot> slots;
+    size_t count;
+};
 }
\ No newline at end of file
@@ -4,6 +4,10 @@
 #include <map>
 #include <optional>
 #include <sstream>
+#include <cstdint>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
 
 namespace csvlib {
 
@@ -66,6 +70,7 @@ protected:
     virtual void open_file(const char* filename) {};
 
     std::fstream file; // filename
+    std::string filename; // path to csv file
     std::string delimiter; // delimiter in csv file, default is ","
     std::vector<std::string> fieldnames; // fieldnames in csv file, vector of strings, optional
 };
@@ -239,6 +244,351 @@ protected:
     void open_file(const char* filename) override;
 };
 
+/**
+ * @brief Binary columnar snapshot of a parsed csv file (typed columns, dictionary-encoded strings)
+ * 
+ * Snapshot is keyed by source path, size, mtime and content hash, starting offset, delimiter and fieldnames, and is memory mapped
+ * on open, so loading it does not parse any rows. Columns whose values are all integers are stored as int64,
+ * low-cardinality columns as a dictionary of distinct strings plus one uint32 code per row, and the rest as plain strings.
+ */
+class CSVSnapshot {
+public:
+    /**
+     * @brief Identity of the csv file a snapshot is built from
+     * 
+     */
+    struct SourceStamp {
+        std::string path; // absolute path
+        uint64_t size = 0; // file size
+        int64_t mtime = 0; // last write time
+        uint64_t hash = 0; // content hash
+    };
+
+    /**
+     * @brief Construct a new empty CSVSnapshot object
+     * 
+     */
+    CSVSnapshot();
+
+    CSVSnapshot(const CSVSnapshot&) = delete;
+    CSVSnapshot& operator=(const CSVSnapshot&) = delete;
+    CSVSnapshot(CSVSnapshot&& other) noexcept;
+    CSVSnapshot& operator=(CSVSnapshot&& other) noexcept;
+
+    ~CSVSnapshot();
+
+    /**
+     * @brief Get identity of csv file (take it before parsing the file, so a file rewritten during parsing is not cached as current)
+     * 
+     * @param source_filename csv file
+     * @return stamp as optional variable (empty if file can't be read)
+     */
+    static std::optional<SourceStamp> stamp_source(const char* source_filename);
+
+    /**
+     * @brief Write parsed csv data to snapshot file (file is replaced atomically)
+     * 
+     * @param cache_filename snapshot filename
+     * @param source stamp of csv file taken before the data was parsed
+     * @param start offset in csv file the data was parsed from
+     * @param delimiter delimiter the data was parsed with
+     * @param fieldnames fieldnames the data was parsed with, vector of strings
+     * @param data parsed data as vector of maps of strings (key - fieldname, value - fieldvalue)
+     * @return true - snapshot is written
+     * @return false - snapshot is not written
+     */
+    static bool write(const char* cache_filename, const SourceStamp& source, uint64_t start, const std::string& delimiter, const std::vector<std::string>& fieldnames, const std::vector<std::map<std::string, std::string>>& data);
+
+    /**
+     * @brief Map snapshot file and check that it was built from the current version of source file with the same delimiter and fieldnames
+     * 
+     * If source mtime changed but content hash still matches, the new mtime is stored in snapshot file, so the next open doesn't hash the source again.
+     * 
+     * @param cache_filename snapshot filename
+     * @param source_filename csv file the snapshot must match
+     * @param start offset in csv file the snapshot must be parsed from
+     * @param delimiter delimiter the snapshot must be parsed with
+     * @param fieldnames fieldnames the snapshot must be parsed with, vector of strings
+     * @return true - snapshot is opened
+     * @return false - snapshot is missing, corrupted or stale
+     */
+    bool open(const char* cache_filename, const char* source_filename, uint64_t start, const std::string& delimiter, const std::vector<std::string>& fieldnames);
+
+    /**
+     * @brief Build snapshot in memory (used when snapshot file can't be written)
+     * 
+     * @param delimiter delimiter the data was parsed with
+     * @param fieldnames fieldnames the data was parsed with, vector of strings
+     * @param data parsed data as vector of maps of strings (key - fieldname, value - fieldvalue)
+     */
+    void assign(const std::string& delimiter, const std::vector<std::string>& fieldnames, const std::vector<std::map<std::string, std::string>>& data);
+
+    /**
+     * @brief Unmap snapshot file
+     * 
+     */
+    void close();
+
+    /**
+     * @brief Get number of rows in snapshot
+     * 
+     * @return number of rows
+     */
+    size_t rows() const;
+
+    /**
+     * @brief Get fieldnames stored in snapshot
+     * 
+     * @return fieldnames, vector of strings
+     */
+    const std::vector<std::string>& get_fieldnames() const;
+
+    /**
+     * @brief Check column type
+     * 
+     * @param column column index
+     * @return true - column is stored as int64
+     * @return false - column is stored as strings
+     */
+    bool is_integer(size_t column) const;
+
+    /**
+     * @brief Get value of integer column
+     * 
+     * @param row row index
+     * @param column column index (must be an integer column)
+     * @return value as int64
+     */
+    int64_t integer(size_t row, size_t column) const;
+
+    /**
+     * @brief Get value of string column without copying (view is valid until snapshot is closed)
+     * 
+     * @param row row index
+     * @param column column index (must be a string column)
+     * @return value as string view into mapped file (throws std::out_of_range if snapshot is corrupted)
+     */
+    std::string_view text(size_t row, size_t column) const;
+
+    /**
+     * @brief Get value of any column as string
+     * 
+     * @param row row index
+     * @param column column index
+     * @return value as string
+     */
+    std::string value(size_t row, size_t column) const;
+
+    /**
+     * @brief Get one row as map of strings
+     * 
+     * @param row row index
+     * @return row as map of strings (key - fieldname, value - fieldvalue)
+     */
+    std::map<std::string, std::string> row(size_t row) const;
+
+    /**
+     * @brief Get all rows as maps of strings (same result as CSVDictReader::read_all_lines, copies every value)
+     * 
+     * @return all data as vector of maps of strings (key - fieldname, value - fieldvalue)
+     */
+    std::vector<std::map<std::string, std::string>> to_dicts() const;
+
+private:
+    struct Column {
+        bool integer; // column type
+        const int64_t* integers; // integer values, one per row
+        const uint64_t* offsets; // string offsets, dictionary_size + 1 values (rows + 1 if column is not encoded)
+        const char* bytes; // string bytes
+        uint64_t bytes_size; // number of string bytes
+        uint64_t dictionary_size; // number of distinct strings
+        const uint32_t* codes; // dictionary codes, one per row (nullptr if column is not encoded)
+    };
+
+    /**
+     * @brief Serialize parsed data in snapshot format
+     * 
+     * @param stream stream to write to
+     * @param source stamp of csv file
+     * @param start offset in csv file the data was parsed from
+     * @param delimiter delimiter the data was parsed with
+     * @param fieldnames fieldnames the data was parsed with, vector of strings
+     * @param data parsed data as vector of maps of strings (key - fieldname, value - fieldvalue)
+     */
+    static void serialize(std::ostream& stream, const SourceStamp& source, uint64_t start, const std::string& delimiter, const std::vector<std::string>& fieldnames, const std::vector<std::map<std::string, std::string>>& data);
+
+    /**
+     * @brief Parse snapshot header and set up column descriptors (row data is not read, it is checked on access)
+     * 
+     * @param cache_filename snapshot filename to store refreshed source mtime in
+     * @param source_filename csv file the snapshot must match (nullptr to skip the check)
+     * @param start offset in csv file the snapshot must be parsed from
+     * @param delimiter delimiter the snapshot must be parsed with
+     * @param fieldnames fieldnames the snapshot must be parsed with, vector of strings
+     * @return true - snapshot is valid
+     * @return false - snapshot is corrupted or does not match
+     */
+    bool load(const char* cache_filename, const char* source_filename, uint64_t start, const std::string& delimiter, const std::vector<std::string>& fieldnames);
+
+    const char* data; // snapshot file contents
+    size_t size; // snapshot file size
+    bool mapped; // data is memory mapped (otherwise it is stored in buffer)
+    std::vector<char> buffer; // snapshot contents if memory mapping is unavailable or snapshot is built in memory
+    size_t row_count; // number of rows
+    std::vector<std::string> fieldnames; // fieldnames stored in snapshot
+    std::vector<Column> columns; // column descriptors pointing into data
+};
+
+/**
+ * @brief Pool of interned strings (each distinct string is stored once and gets a small integer code)
+ * 
+ */
+class CSVStringPool {
+public:
+    /**
+     * @brief Construct a new empty CSVStringPool object
+     * 
+     */
+    CSVStringPool();
+
+    CSVStringPool(const CSVStringPool&) = delete;
+    CSVStringPool& operator=(const CSVStringPool&) = delete;
+    CSVStringPool(CSVStringPool&&) = default;
+    CSVStringPool& operator=(CSVStringPool&&) = default;
+
+    /**
+     * @brief Add string to pool if it is not there yet
+     * 
+     * @param str string to intern
+     * @return code of the string
+     */
+    uint32_t intern(std::string_view str);
+
+    /**
+     * @brief Get code of string without adding it
+     * 
+     * @param str string to look up
+     * @return code as optional variable (empty if string is not in pool)
+     */
+    std::optional<uint32_t> find(std::string_view str) const;
+
+    /**
+     * @brief Get string by code (view is valid while pool exists)
+     * 
+     * @param code code returned by intern
+     * @return interned string
+     */
+    std::string_view at(uint32_t code) const;
+
+    /**
+     * @brief Get number of distinct strings in pool
+     * 
+     * @return number of strings
+     */
+    size_t size() const;
+
+private:
+    std::deque<std::string> strings; // interned strings, deque keeps them in place when growing
+    std::unordered_map<std::string_view, uint32_t> codes; // string (view into strings) to code
+};
+
+/**
+ * @brief Column of csv values, optionally dictionary-encoded
+ * 
+ * Encoded column stores each distinct value once in a CSVStringPool and one uint32 code per row,
+ * so equality filters become integer compares. When number of distinct values exceeds max_cardinality
+ * the column falls back to plain strings.
+ */
+class CSVColumn {
+public:
+    /**
+     * @brief Construct a new plain (not encoded) CSVColumn object
+     * 
+     */
+    CSVColumn();
+
+    /**
+     * @brief Construct a new CSVColumn object
+     * 
+     * @param encoded dictionary-encode values
+     * @param max_cardinality max number of distinct values before falling back to plain strings
+     */
+    CSVColumn(bool encoded, size_t max_cardinality);
+
+    /**
+     * @brief Append value to the end of column
+     * 
+     * @param value value to append
+     */
+    void push_back(std::string_view value);
+
+    /**
+     * @brief Get number of values in column
+     * 
+     * @return number of values
+     */
+    size_t size() const;
+
+    /**
+     * @brief Check column encoding
+     * 
+     * @return true - column is dictionary-encoded
+     * @return false - column stores plain strings
+     */
+    bool is_encoded() const;
+
+    /**
+     * @brief Get code of value in row (encoded column only)
+     * 
+     * @param row row index
+     * @return code in dictionary (throws std::logic_error if column is not encoded)
+     */
+    uint32_t code(size_t row) const;
+
+    /**
+     * @brief Get codes of all rows (encoded column only)
+     * 
+     * @return codes, one per row (throws std::logic_error if column is not encoded)
+     */
+    const std::vector<uint32_t>& get_codes() const;
+
+    /**
+     * @brief Get dictionary of distinct values (encoded column only)
+     * 
+     * @return dictionary, code to value (throws std::logic_error if column is not encoded)
+     */
+    const CSVStringPool& dictionary() const;
+
+    /**
+     * @brief Get code of value to compare with codes (encoded column only, check is_encoded() first: column may fall back to plain strings)
+     * 
+     * @param value value to look up
+     * @return code as optional variable (empty if value does not appear in column) (throws std::logic_error if column is not encoded)
+     */
+    std::optional<uint32_t> find(std::string_view value) const;
+
+    /**
+     * @brief Get value in row (view is valid while column exists and is not modified)
+     * 
+     * @param row row index
+     * @return value
+     */
+    std::string_view value(size_t row) const;
+
+private:
+    /**
+     * @brief Throw std::logic_error if column is not encoded
+     * 
+     */
+    void check_encoded() const;
+
+    bool encoded; // values are dictionary-encoded
+    size_t max_cardinality; // max number of distinct values in encoded column
+    CSVStringPool pool; // dictionary of encoded column
+    std::vector<uint32_t> codes; // codes of encoded column
+    std::vector<std::string> values; // values of plain column
+};
+
 /**
  * @brief CSV dictionary reader (map of strings (key - fieldname, value - fieldvalue))
  * 
@@ -291,6 +641,31 @@ public:
      */
     std::vector<std::map<std::string, std::string>> read_all_lines();
 
+    /**
+     * @brief Get the all lines from binary snapshot if it matches csv file and current position in it, otherwise parse csv file and write the snapshot (stream is at the end of file afterwards in both cases)
+     * 
+     * @param cache_filename snapshot filename
+     * @return all data as vector of maps of strings (key - fieldname, value - fieldvalue) (empty vector if no data)
+     */
+    std::vector<std::map<std::string, std::string>> read_all_lines(const char* cache_filename);
+
+    /**
+     * @brief Get the all lines from csv file as columnar snapshot without copying values (snapshot is loaded from cache_filename if it matches csv file, current position in it, delimiter and fieldnames, otherwise csv file is parsed and the snapshot is written)
+     * 
+     * @param cache_filename snapshot filename
+     * @return snapshot with all data (built in memory if snapshot file can't be written)
+     */
+    CSVSnapshot read_snapshot(const char* cache_filename);
+
+    /**
+     * @brief Get the all lines from csv file as columns (cells of encoded columns are not copied into separate strings)
+     * 
+     * @param encoded_fieldnames fieldnames of columns to dictionary-encode, vector of strings (throws std::invalid_argument if one is not in fieldnames)
+     * @param max_cardinality max number of distinct values in encoded column, column with more values is stored as plain strings
+     * @return all data as map of columns (key - fieldname, value - column)
+     */
+    std::map<std::string, CSVColumn> read_all_columns(const std::vector<std::string>& encoded_fieldnames = {}, size_t max_cardinality = 65536);
+
 protected:
     /**
      * @brief Open csv file in read mode
@@ -408,4 +783,121 @@ protected:
     void open_file(const char* filename) override;
 };
 
+/**
+ * @brief Lightweight read-only view of one row returned by CSVIndex (valid while indexed data exists)
+ * 
+ */
+class CSVRecordView {
+public:
+    /**
+     * @brief Construct a new CSVRecordView object
+     * 
+     * @param record row to view
+     */
+    explicit CSVRecordView(const std::map<std::string, std::string>& record);
+
+    /**
+     * @brief Get field value
+     * 
+     * @param fieldname fieldname
+     * @return field value (throws std::out_of_range if there is no such field)
+     */
+    const std::string& at(const std::string& fieldname) const;
+
+    /**
+     * @brief Get the whole row
+     * 
+     * @return row as map of strings (key - fieldname, value - fieldvalue)
+     */
+    const std::map<std::string, std::string>& fields() const;
+
+private:
+    const std::map<std::string, std::string>* record; // viewed row
+};
+
+/**
+ * @brief Hash index over one or more key columns of CSVDictReader data
+ * 
+ * Rows are stored in an open-addressing table of row numbers tagged with key hash (8 bytes per slot,
+ * load factor at most 1/2), key values are not copied, so find() is O(1) on average and compares
+ * against the indexed rows. Index keeps a pointer to the data, data must outlive the index
+ * (constructing from a temporary is not allowed).
+ * Index is immutable after construction, so it is safe to use from multiple reader threads.
+ * If several rows have the same key, the first one is indexed.
+ */
+class CSVIndex {
+public:
+    /**
+     * @brief Construct a new CSVIndex object
+     * 
+     * @param data data to index as vector of maps of strings (key - fieldname, value - fieldvalue)
+     * @param key_fieldnames fieldnames of key columns, vector of strings (throws std::length_error if data has UINT32_MAX rows or more)
+     */
+    CSVIndex(const std::vector<std::map<std::string, std::string>>& data, const std::vector<std::string>& key_fieldnames);
+
+    CSVIndex(std::vector<std::map<std::string, std::string>>&& data, const std::vector<std::string>& key_fieldnames) = delete;
+
+    /**
+     * @brief Find row by key
+     * 
+     * @param key key column values in the same order as key_fieldnames
+     * @return row view as optional variable (empty if key is not found) (throws std::invalid_argument if number of values differs from number of key columns)
+     */
+    std::optional<CSVRecordView> find(const std::vector<std::string>& key) const;
+
+    /**
+     * @brief Find row by single column key
+     * 
+     * @param key key column value
+     * @return row view as optional variable (empty if key is not found) (throws std::invalid_argument if index has several key columns)
+     */
+    std::optional<CSVRecordView> find(std::string_view key) const;
+
+    /**
+     * @brief Get number of distinct keys in index
+     * 
+     * @return number of keys
+     */
+    size_t size() const;
+
+private:
+    struct Slot {
+        uint32_t row; // row number + 1 (0 - empty slot)
+        uint32_t tag; // upper half of key hash, checked before comparing key values
+    };
+
+    /**
+     * @brief Get key column value of indexed row
+     * 
+     * @param row row index
+     * @param column key column index
+     * @return value (empty if row has no such field)
+     */
+    std::string_view field(size_t row, size_t column) const;
+
+    /**
+     * @brief Hash key values
+     * 
+     * @param key key column values, key[i] is convertible to string view
+     * @return hash
+     */
+    template <typename Key>
+    uint64_t hash_key(const Key& key) const;
+
+    /**
+     * @brief Find slot holding row with given key
+     * 
+     * @param key key column values, key[i] is convertible to string view
+     * @param hash hash of key
+     * @return slot number (empty slot if key is not found)
+     */
+    template <typename Key>
+    size_t probe(const Key& key, uint64_t hash) const;
+
+    const std::vector<std::map<std::string, std::string>>* data; // indexed data
+    std::vector<std::string> key_fieldnames; // key columns
+    std::vector<Slot> slots; // open-addressing table
+    size_t count; // number of distinct keys
+};
+
 }
\ No newline at end of file